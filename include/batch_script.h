@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Batch scripts are plain text, one directive per line, '#' starts a
+// comment:
+//   frames 300               number of frames to run
+//   fov 60                   keep a ParamMenu parameter fixed
+//   rot_y 0 6.28             sweep it linearly over the run
+//   camera 0,0,-1 0,0,-8     matrix params take comma separated components
+struct ParamSweep {
+    std::string name;
+    std::vector<long double> from;
+    std::vector<long double> to;
+
+    // Value for the given frame, formatted for ParamInterface::set
+    std::string value_at(int frame, int frames) const;
+};
+
+struct BatchScript {
+    int frames = 100;
+    std::vector<ParamSweep> sweeps;
+
+    // On failure error describes the offending line
+    bool load(const std::string& path, std::string& error);
+};
@@ -26,8 +26,12 @@ public:
     ScreenBuffer(int width, int height);
 
     void resize(int width, int height);
+    int get_width() const { return width; }
+    int get_height() const { return height; }
     void clear();
     void print(int x = 0, int y = 0);
+    size_t dump(std::string& out) const;
+    size_t filled() const;
     void put(int x, int y, chtype ch);
     void put(int x, int y, chtype ch, attr_t attr);
     void put(int x, int y, chtype ch, CharColor color, attr_t attr);
@@ -11,6 +11,19 @@ Point3f m4_cross_v3(Eigen::Matrix4f mat, Point3f vec) {
     return {cross(0), cross(1), cross(2)};
 }
 
+// Single matrix equivalent to applying every stage with m4_cross_v3 in
+// order. m4_cross_v3 drops w after each stage, so only the affine rows of
+// each stage take part in the product.
+Eigen::Matrix4f compose_stages(const Eigen::Matrix4f* stages, int n) {
+    Eigen::Matrix4f out = Eigen::Matrix4f::Identity();
+    for (int i = 0; i < n; ++i) {
+        Eigen::Matrix4f affine = stages[i];
+        affine.row(3) << 0, 0, 0, 1;
+        out = affine * out;
+    }
+    return out;
+}
+
 Eigen::Matrix4f scale_matrix(float x, float y, float z) {
     return Eigen::Matrix4f{
         {x, 0, 0, 1}, {0, y, 0, 1}, {0, 0, z, 1}, {0, 0, 0, 1}};
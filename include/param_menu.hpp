@@ -1,6 +1,10 @@
+#pragma once
+
 #include <Eigen/Dense>
 #include <Eigen/src/Core/Matrix.h>
+#include <algorithm>
 #include <pdcurses/curses.h>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -16,6 +20,9 @@ public:
     virtual ~ParamInterface() {}
     virtual void print(WINDOW* win) {}
     virtual void input(int ch) {}
+    // Assigns a value given as text, used when there is no keyboard
+    virtual void set(const std::string& value) {}
+    const std::string& get_name() const { return name; }
 };
 
 template <typename T>
@@ -55,6 +62,9 @@ public:
             this->val++;
         }
     }
+    void set(const std::string& value) override {
+        this->val = std::stoll(value);
+    }
 };
 
 static void float_string_editor(std::string& str, bool& dot, int ch) {
@@ -115,6 +125,11 @@ public:
         float_string_editor(str, dot, ch);
         this->val = std::stold(str);
     }
+    void set(const std::string& value) override {
+        this->val = std::stold(value);
+        str       = ldtos(this->val);
+        dot       = float(int(this->val)) != this->val;
+    }
 };
 
 template <int Rows, int Cols, typename Scalar = float>
@@ -175,6 +190,19 @@ public:
             this->val(selected / Cols, selected % Cols) = stold(arr[selected]);
         }
     }
+    // Components separated by commas or spaces, missing ones are kept
+    void set(const std::string& value) override {
+        std::string list = value;
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream in(list);
+        long double cur;
+        for (int i = 0; i < Rows * Cols && in >> cur; ++i) {
+            this->val(i / Cols, i % Cols) = cur;
+            arr[i]  = ldtos(cur);
+            dots[i] = float(int(cur)) != cur;
+            width   = std::max(width, int(arr[i].size()));
+        }
+    }
 };
 
 class ParamMenu {
@@ -185,6 +213,8 @@ class ParamMenu {
     int height  = LINES;
     std::vector<ParamInterface*> params;
     std::unordered_map<std::string, ParamInterface*> namedParams;
+    std::unordered_map<std::string, std::string> pending;
+    std::vector<ParamInterface*> owned;
     int scroll   = 0;
     int selected = 0;
     int bottom;
@@ -196,7 +226,7 @@ public:
     }
 
     ~ParamMenu() {
-        for (auto i : params) {
+        for (auto i : owned) {
             delete i;
         }
     }
@@ -209,7 +239,8 @@ public:
         if (win != nullptr) {
             delwin(win);
         }
-        win = newwin(height, width, y, x);
+        // Without initscr (headless runs) there is nothing to draw into
+        win = stdscr != nullptr ? newwin(height, width, y, x) : nullptr;
 
         startx       = x;
         starty       = y;
@@ -217,14 +248,33 @@ public:
         this->height = height;
         bottom       = height;
     }
-    void add_param(ParamInterface* param) { params.push_back(param); }
+    void add_param(ParamInterface* param) {
+        params.push_back(param);
+        namedParams[param->get_name()] = param;
+    }
+    bool has_param(const std::string& name) const {
+        return namedParams.count(name) != 0;
+    }
+    // Params that are not emplaced yet get the value once they are
+    void set_param(std::string name, std::string value) {
+        if (namedParams.count(name) == 0) {
+            pending[name] = value;
+        } else {
+            namedParams[name]->set(value);
+        }
+    }
     template <typename T, typename... Types>
     auto emplace_param(std::string name, Types... args) {
         T* cur;
         if (namedParams.count(name) == 0) {
             cur = new T(name, args...);
             params.push_back(reinterpret_cast<ParamInterface*>(cur));
+            owned.push_back(reinterpret_cast<ParamInterface*>(cur));
             namedParams[name] = reinterpret_cast<ParamInterface*>(cur);
+            if (pending.count(name) != 0) {
+                cur->set(pending[name]);
+                pending.erase(name);
+            }
         } else {
             cur = reinterpret_cast<T*>(namedParams[name]);
         }
@@ -238,6 +288,9 @@ public:
             }
 
             auto in = getch();
+            if (in == ERR) {
+                continue;
+            }
             switch (in & 0xFF | (in > 0xFF ? 0x100 : 0)) {
                 case 'j':
                     selected = std::min(selected + 1, n - 1);
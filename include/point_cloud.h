@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common_types.h"
+#include "console_draw.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Glyphs from sparse to dense; cell density picks one of them.
+#define DENSITY_RAMP " .:-=+*#%@"
+
+// Large point sets splatted as per-cell density instead of one put per
+// point. Positions are kept as separate x/y/z arrays so the transform runs
+// over contiguous floats.
+class PointCloud {
+    struct Histogram {
+        std::vector<uint32_t> hits;
+        std::vector<float> depth;
+    };
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<float> zs;
+    std::vector<Histogram> histograms;
+    unsigned threads = 1;
+
+    void accumulate(Histogram& hist, size_t from, size_t to,
+                    const Eigen::Matrix4f& transform, Point2f offset,
+                    int width, int height) const;
+
+public:
+    // 0 threads means one per hardware thread
+    PointCloud(unsigned threads = 0);
+
+    void clear();
+    void reserve(size_t n);
+    void add(Point3f point);
+    size_t size() const { return xs.size(); }
+
+    // Raw little-endian float32 x y z triples, as dumped by most lidar tools
+    bool load_xyz(const std::string& path);
+
+    // transform is applied as m4_cross_v3 does, then offset moves the
+    // result into buffer coordinates. Returns the number of cells hit.
+    size_t draw(ScreenBuffer& buf, const Eigen::Matrix4f& transform,
+                Point2f offset, Color color);
+};
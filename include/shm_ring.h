@@ -0,0 +1,96 @@
+#pragma once
+
+#include "common_types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define SHM_RING_MAGIC 0x52434433 // "3DCR"
+#define SHM_RING_VERSION 1
+
+static_assert(sizeof(Point3f) == 3 * sizeof(float),
+              "Point3f must be tightly packed to live in shared memory");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory handoff needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory handoff needs lock-free 32-bit atomics");
+
+typedef uint32_t ShmFace[3];
+
+// Layout of the shared memory object:
+//   ShmRingHeader
+//   slots * (ShmRingSlot, Point3f[maxPoints], ShmFace[maxFaces])
+// Every slot is guarded by its own seqlock: seq is odd while the producer
+// writes the slot and even once the frame in it is complete. The header's
+// latest counter holds the number of the last completed frame, so slot
+// (latest - 1) % slots is always the newest one.
+struct ShmRingHeader {
+    // Stored last with release, so a reader that sees it sees the rest
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t maxPoints;
+    uint32_t maxFaces;
+    uint32_t slotSize;
+    std::atomic<uint64_t> latest;
+};
+
+struct ShmRingSlot {
+    std::atomic<uint64_t> seq;
+    uint32_t pointCount;
+    uint32_t faceCount;
+};
+
+// Points straight into the mapped memory, nothing is copied.
+struct ShmFrameView {
+    const Point3f* points   = nullptr;
+    const ShmFace* faces    = nullptr;
+    size_t pointCount       = 0;
+    size_t faceCount        = 0;
+    uint64_t frame          = 0;
+    uint64_t seq            = 0;
+    const ShmRingSlot* slot = nullptr;
+};
+
+class ShmRing {
+    std::string name;
+    void* base            = nullptr;
+    size_t size           = 0;
+    bool owner            = false;
+    ShmRingHeader* header = nullptr;
+    uint64_t written      = 0;
+
+    ShmRingSlot* slot_at(uint64_t frame) const;
+    Point3f* slot_points(ShmRingSlot* slot) const;
+    ShmFace* slot_faces(ShmRingSlot* slot) const;
+
+public:
+    ShmRing() = default;
+    ShmRing(const ShmRing&)            = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+    ~ShmRing();
+
+    // Producer side: creates (or recreates) the object and owns it.
+    bool create(std::string name, uint32_t slots, uint32_t maxPoints,
+                uint32_t maxFaces);
+    // Consumer side: maps an object created by a producer, read only.
+    bool open(std::string name);
+    void close();
+    bool is_open() const { return header != nullptr; }
+
+    uint32_t max_points() const { return header->maxPoints; }
+    uint32_t max_faces() const { return header->maxFaces; }
+
+    // Writes go straight into the next slot between begin_write and
+    // end_write; the frame becomes visible to readers in end_write.
+    void begin_write(Point3f*& points, ShmFace*& faces);
+    void end_write(uint32_t pointCount, uint32_t faceCount);
+
+    // Fills view with the latest completed frame. Returns false if there is
+    // none yet or the producer is overwriting it right now.
+    bool acquire(ShmFrameView& view) const;
+    // Must be called once the view has been consumed: false means the
+    // producer lapped the ring meanwhile and the data read may be torn.
+    bool validate(const ShmFrameView& view) const;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common_types.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Heightmap terrain split into square chunks that are triangulated on a
+// background thread around the camera. The heightmap is a memory-mapped
+// raw square grid of little-endian uint16 samples (.r16), with mmap on
+// POSIX and MapViewOfFile on Windows, so only the pages of chunks near the
+// camera are ever read. The render thread only
+// swaps finished chunks in and drops far ones in update(), it never waits
+// for the file or the worker.
+class Terrain {
+public:
+    struct Chunk {
+        int x   = 0;
+        int z   = 0;
+        int lod = 0;
+        std::vector<Point3f> points;
+        std::vector<std::array<uint32_t, 3>> faces;
+    };
+    typedef std::pair<int, int> ChunkKey;
+
+private:
+    struct Request {
+        ChunkKey key;
+        int lod;
+        float distance;
+    };
+
+    void* map              = nullptr;
+    size_t mapSize         = 0;
+    const uint8_t* samples = nullptr;
+    int side               = 0;
+    int chunksPerSide      = 0;
+
+    // Owned by the render thread
+    std::map<ChunkKey, std::unique_ptr<Chunk>> chunks;
+
+    // Shared with the worker, guarded by lock
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable built;
+    std::vector<Request> pending;
+    std::vector<std::unique_ptr<Chunk>> ready;
+    std::map<ChunkKey, int> inFlight;
+    bool stopping = false;
+    std::thread worker;
+
+    void work();
+    std::unique_ptr<Chunk> build(const Request& request) const;
+    float sample(int x, int z) const;
+    float chunk_distance(ChunkKey key, Point3f camera) const;
+
+public:
+    // Set before open
+    float spacing      = 0.05f; // world units between samples
+    float heightScale  = 1;     // world height of the largest sample
+    int chunkSamples   = 32;    // samples along a chunk side at LOD 0
+    int maxLod         = 3;     // every LOD halves the samples per side
+    float lodDistance  = 1;     // world distance per LOD step
+    float viewDistance = 4;     // chunks further away are evicted
+
+    Terrain() = default;
+    Terrain(const Terrain&)            = delete;
+    Terrain& operator=(const Terrain&) = delete;
+    ~Terrain();
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return samples != nullptr; }
+
+    // Call once per frame: takes finished chunks, evicts far ones and
+    // queues what is still missing around the camera, nearest first.
+    // Returns true once every chunk in view is loaded at its wanted LOD.
+    bool update(Point3f camera);
+    // Blocks until the worker has nothing queued or in progress. Only for
+    // runs that need reproducible output; interactive ones never wait.
+    void wait_idle();
+    const std::map<ChunkKey, std::unique_ptr<Chunk>>& get_chunks() const {
+        return chunks;
+    }
+};
@@ -1,24 +1,364 @@
+#include "batch_script.h"
 #include "common_types.h"
 #include "console_draw.h"
 #include "matrices.hpp"
 #include "param_menu.hpp"
+#include "point_cloud.h"
+#include "shm_ring.h"
+#include "terrain.h"
 #include <Eigen/src/Core/Matrix.h>
 #include <chrono>
+#include <cstdio>
 #include <pdcurses/curses.h>
+#include <string>
+#include <vector>
 
 using namespace std;
 
-int main() {
+struct Scene {
+    ShmRing ring;
+    PointCloud cloud;
+    Point3f orgPoints[4] = {{0, -1, 2}, {2, -1, -2}, {-2, -1, -2}, {0, 0, 0}};
+    ShmFace orgFaces[4]  = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}};
+    vector<Point3f> points;
+    // Last frame from the ring that validated, shown instead of torn ones
+    ScreenBuffer lastGood;
+    uint64_t lastFrame   = 0;
+    size_t lastTriangles = 0;
+    uint64_t tornFrames  = 0;
+    Terrain terrain;
+    vector<Point3f> terrainPoints;
+};
+
+struct FrameStats {
+    long long stagesUs    = 0;
+    long long transformUs = 0;
+    long long rasterUs    = 0;
+    long long streamUs    = 0;
+    long long terrainUs   = 0;
+    long long cloudUs     = 0;
+    long long emitUs      = 0;
+    size_t triangles      = 0;
+    size_t chunks         = 0;
+    size_t cells          = 0;
+    size_t bytes          = 0;
+    uint64_t frame        = 0;
+    int retries           = 0;
+    bool torn             = false;
+};
+
+// Microseconds since the given point, which is moved to now
+static long long lap_us(chrono::high_resolution_clock::time_point& since) {
+    auto now = chrono::high_resolution_clock::now();
+    auto us  = chrono::duration_cast<chrono::microseconds>(now - since).count();
+    since    = now;
+    return us;
+}
+
+static void build_stages(ParamMenu& pm, MatrixParam<1, 4>& order,
+                         Eigen::Matrix4f* stages) {
+    for (int j = 0; j < 4; ++j) {
+        stages[j] = Eigen::Matrix4f::Identity();
+        switch (int(order()(j))) {
+            case 1:
+                stages[j] = scale_matrix(
+                    pm.emplace_param<FloatParam<>>("scale_x", 1),
+                    pm.emplace_param<FloatParam<>>("scale_y", 1),
+                    pm.emplace_param<FloatParam<>>("scale_z", 1));
+                break;
+            case 2:
+                stages[j] = rotation_matrix(
+                    pm.emplace_param<FloatParam<>>("rot_x"),
+                    pm.emplace_param<FloatParam<>>("rot_y"),
+                    pm.emplace_param<FloatParam<>>("rot_z"));
+                break;
+            case 3:
+                stages[j] = look_at_camera_matrix(
+                    pm.emplace_param<MatrixParam<1, 3>>("camera", Point3f{0, 0, -1}),
+                    pm.emplace_param<MatrixParam<1, 3>>("target"),
+                    {0, 1, 0});
+                break;
+            case 4:
+                stages[j] = horizontal_fov_projection_matrix(
+                    pm.emplace_param<FloatParam<>>("fov", 60),
+                    pm.emplace_param<FloatParam<>>("aspect_ratio", 1),
+                    pm.emplace_param<FloatParam<>>("close", 0.5),
+                    pm.emplace_param<FloatParam<>>("far", 100));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static Point3f camera_position(ParamMenu& pm) {
+    return pm.emplace_param<MatrixParam<1, 3>>("camera", Point3f{0, 0, -1})
+        .transpose();
+}
+
+static void render_frame(Scene& scene, const Eigen::Matrix4f* stages,
+                         Point3f camera, ScreenBuffer& buf, Color color,
+                         int ch, FrameStats& stats) {
+    Point3f center{float(buf.get_width()) / 2,
+                   float(buf.get_height() + 1) / 2, 0};
+    auto& points = scene.points;
+    auto start   = chrono::high_resolution_clock::now();
+    bool builtin = scene.cloud.size() == 0 && !scene.terrain.is_open();
+    ShmFrameView view;
+    bool valid        = false;
+    bool acquired     = false;
+    stats.transformUs = 0;
+    stats.rasterUs    = 0;
+    stats.retries     = 0;
+    // Retry a few times if the producer laps the ring while we draw
+    for (int attempt = 0; attempt < 4 && !valid; ++attempt) {
+        if (attempt > 0) {
+            ++stats.retries;
+        }
+        view.points     = scene.orgPoints;
+        view.faces      = scene.orgFaces;
+        view.pointCount = builtin ? 4 : 0;
+        view.faceCount  = builtin ? 4 : 0;
+        view.slot       = nullptr;
+        if (scene.ring.is_open() && !scene.ring.acquire(view)) {
+            continue;
+        }
+        acquired = acquired || view.slot != nullptr;
+
+        points.resize(view.pointCount);
+        for (size_t i = 0; i < view.pointCount; ++i) {
+            points[i] = view.points[i];
+            for (int j = 0; j < 4; ++j) {
+                points[i] = m4_cross_v3(stages[j], points[i]);
+            }
+            points[i] += center;
+        }
+        stats.transformUs += lap_us(start);
+        // Don't pay for rasterizing positions that are already torn
+        if (view.slot != nullptr && !scene.ring.validate(view)) {
+            continue;
+        }
+
+        buf.clear();
+        buf.set_color({0, 0, 0, color[0], color[1], color[2]});
+        stats.triangles = 0;
+        for (size_t i = 0; i < view.faceCount; ++i) {
+            auto& f = view.faces[i];
+            if (f[0] >= points.size() || f[1] >= points.size() ||
+                f[2] >= points.size()) {
+                continue;
+            }
+            buf.draw_tri({round(points[f[0]][0]), round(points[f[0]][1])},
+                         {round(points[f[1]][0]), round(points[f[1]][1])},
+                         {round(points[f[2]][0]), round(points[f[2]][1])},
+                         ch);
+            ++stats.triangles;
+        }
+        stats.rasterUs += lap_us(start);
+        valid = view.slot == nullptr || scene.ring.validate(view);
+    }
+    if (scene.ring.is_open()) {
+        if (valid) {
+            scene.lastGood      = buf;
+            scene.lastFrame     = view.frame;
+            scene.lastTriangles = stats.triangles;
+        } else {
+            // Nothing validated yet means there is no good frame to fall
+            // back to, so show an empty buffer of the real size instead
+            if (scene.lastFrame != 0) {
+                buf = scene.lastGood;
+            } else {
+                buf.clear();
+            }
+            // Only a frame that was read and then overwritten is torn, not
+            // one the producer hasn't published or is still writing
+            if (acquired) {
+                ++scene.tornFrames;
+                stats.torn = true;
+            }
+        }
+        stats.frame     = scene.lastFrame;
+        stats.triangles = scene.lastTriangles;
+    }
+
+    Eigen::Matrix4f transform = compose_stages(stages, 4);
+    if (scene.terrain.is_open()) {
+        scene.terrain.update(camera);
+        auto& terrainPoints = scene.terrainPoints;
+        for (auto& entry : scene.terrain.get_chunks()) {
+            auto& chunk = *entry.second;
+            terrainPoints.resize(chunk.points.size());
+            // m4_cross_v3 drops the look_at translation (it lives in row
+            // 3), so chunks are moved into camera space by hand; otherwise
+            // the view would stay at the world origin while chunks stream
+            // in around the camera.
+            for (size_t i = 0; i < chunk.points.size(); ++i) {
+                terrainPoints[i] =
+                    m4_cross_v3(transform, chunk.points[i] - camera) + center;
+            }
+            for (auto& f : chunk.faces) {
+                buf.draw_tri({round(terrainPoints[f[0]][0]), round(terrainPoints[f[0]][1])},
+                             {round(terrainPoints[f[1]][0]), round(terrainPoints[f[1]][1])},
+                             {round(terrainPoints[f[2]][0]), round(terrainPoints[f[2]][1])},
+                             ch);
+                ++stats.triangles;
+            }
+        }
+        stats.chunks    = scene.terrain.get_chunks().size();
+        stats.terrainUs = lap_us(start);
+    }
+
+    scene.cloud.draw(buf, transform, {center[0], center[1]}, color);
+    stats.cloudUs = lap_us(start);
+    stats.cells   = buf.filled();
+}
+
+// Runs the scene without a terminal, sweeping parameters as the script
+// says and writing one CSV row of timings and counts per frame.
+static int run_batch(Scene& scene, const BatchScript& script, FILE* csv,
+                     int width, int height) {
+    ParamMenu pm(0, 0, width, height);
+    MatrixParam<1, 4> order("order", {1, 2, 3, 4});
+    pm.add_param(&order);
+
+    ScreenBuffer buf(width, height - 1);
+    buf.set_attr(A_ITALIC);
+    string emitted;
+
+    // Params are created on first use, so build every stage once, whatever
+    // order says, before checking that each sweep names a real one; a typo
+    // would otherwise sweep nothing while still filling its CSV column.
+    Eigen::Matrix4f stages[4];
+    MatrixParam<1, 4> allStages("order", {1, 2, 3, 4});
+    for (auto& sweep : script.sweeps) {
+        pm.set_param(sweep.name, sweep.value_at(0, script.frames));
+    }
+    build_stages(pm, allStages, stages);
+    for (auto& sweep : script.sweeps) {
+        if (!pm.has_param(sweep.name)) {
+            fprintf(stderr, "Unknown parameter %s in batch script\n",
+                    sweep.name.c_str());
+            return 1;
+        }
+    }
+
+    fprintf(csv, "frame");
+    for (auto& sweep : script.sweeps) {
+        fprintf(csv, ",%s", sweep.name.c_str());
+    }
+    fprintf(csv, ",stages_us,stream_us,transform_us,raster_us,terrain_us,"
+                 "cloud_us,emit_us,triangles,chunks,cells,bytes,retries,torn\n");
+
+    vector<string> values(script.sweeps.size());
+    for (int frame = 0; frame < script.frames; ++frame) {
+        for (size_t i = 0; i < script.sweeps.size(); ++i) {
+            values[i] = script.sweeps[i].value_at(frame, script.frames);
+            pm.set_param(script.sweeps[i].name, values[i]);
+        }
+
+        FrameStats stats;
+        auto start = chrono::high_resolution_clock::now();
+        build_stages(pm, order, stages);
+        stats.stagesUs = lap_us(start);
+        // Let terrain streaming settle so every run draws the same chunks;
+        // the wait is reported on its own instead of as draw time.
+        Point3f camera = camera_position(pm);
+        while (!scene.terrain.update(camera)) {
+            scene.terrain.wait_idle();
+        }
+        stats.streamUs = lap_us(start);
+        render_frame(scene, stages, camera, buf, {1, 1, 1}, '#', stats);
+        start        = chrono::high_resolution_clock::now();
+        stats.bytes  = buf.dump(emitted);
+        stats.emitUs = lap_us(start);
+
+        fprintf(csv, "%d", frame);
+        for (auto& value : values) {
+            fprintf(csv, ",\"%s\"", value.c_str());
+        }
+        fprintf(csv, ",%lld,%lld,%lld,%lld,%lld,%lld,%lld,%zu,%zu,%zu,%zu,%d,%d\n",
+                stats.stagesUs, stats.streamUs, stats.transformUs,
+                stats.rasterUs, stats.terrainUs, stats.cloudUs, stats.emitUs,
+                stats.triangles, stats.chunks, stats.cells, stats.bytes,
+                stats.retries, int(stats.torn));
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --shm <name>: draw frames pushed by an external producer instead of
+    // the built-in mesh
+    // --cloud <file>: splat a raw float32 xyz point cloud
+    // --terrain <file>: stream a square raw uint16 heightmap around the
+    // camera
+    // --batch <script> [--csv <file>] [--size <w>x<h>]: run headless, see
+    // batch_script.h for the script format
+    Scene scene;
+    const char* batchPath = nullptr;
+    const char* csvPath   = nullptr;
+    int batchWidth        = 120;
+    int batchHeight       = 40;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc) {
+            if (!scene.ring.open(argv[++i])) {
+                fprintf(stderr, "Failed to open shared memory ring %s\n",
+                        argv[i]);
+                return 1;
+            }
+        } else if (arg == "--cloud" && i + 1 < argc) {
+            if (!scene.cloud.load_xyz(argv[++i])) {
+                fprintf(stderr, "Failed to load point cloud %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--terrain" && i + 1 < argc) {
+            if (!scene.terrain.open(argv[++i])) {
+                fprintf(stderr, "Failed to open heightmap %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &batchWidth, &batchHeight) != 2 ||
+                batchWidth <= 0 || batchHeight <= 1) {
+                fprintf(stderr, "Bad size %s, expected <w>x<h>\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    if (batchPath != nullptr) {
+        BatchScript script;
+        string error;
+        if (!script.load(batchPath, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        FILE* csv = csvPath != nullptr ? fopen(csvPath, "w") : stdout;
+        if (csv == nullptr) {
+            fprintf(stderr, "Failed to open %s\n", csvPath);
+            return 1;
+        }
+        int result = run_batch(scene, script, csv, batchWidth, batchHeight);
+        if (csv != stdout) {
+            fclose(csv);
+        }
+        return result;
+    }
+
     initscr();
     raw();
     keypad(stdscr, true);
     noecho();
     curs_set(0);
     start_color_and_pairs();
-
-    Point3f orgPoints[4] = {{0, -1, 2}, {2, -1, -2}, {-2, -1, -2}, {0, 0, 0}};
-    Point3f points[4];
-    size_t faces[4][3] = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}};
+    if (scene.ring.is_open() || scene.terrain.is_open()) {
+        // keep redrawing while frames or chunks arrive in the background
+        // instead of waiting for keys
+        timeout(15);
+    }
 
     ParamMenu pm(COLS * 2 / 3, 0, COLS / 3, LINES);
     wattrset(pm.get_win(), color_to_attr({0, 0, 0, 1, 1, 1}));
@@ -32,43 +372,11 @@ int main() {
     buf.set_attr(A_ITALIC);
 
     while (true) {
-        for (int i = 0; i < 4; ++i) {
-            points[i] = orgPoints[i];
-            for (int j = 0; j < 4; ++j) {
-                auto mat = Eigen::Matrix4f::Identity().eval();
-                switch (int(order()(j))) {
-                    case 1:
-                        mat = scale_matrix(
-                            pm.emplace_param<FloatParam<>>("scale_x", 1),
-                            pm.emplace_param<FloatParam<>>("scale_y", 1),
-                            pm.emplace_param<FloatParam<>>("scale_z", 1));
-                        break;
-                    case 2:
-                        mat = rotation_matrix(
-                            pm.emplace_param<FloatParam<>>("rot_x"),
-                            pm.emplace_param<FloatParam<>>("rot_y"),
-                            pm.emplace_param<FloatParam<>>("rot_z"));
-                        break;
-                    case 3:
-                        mat = look_at_camera_matrix(
-                            pm.emplace_param<MatrixParam<1, 3>>("camera", Point3f{0, 0, -1}),
-                            pm.emplace_param<MatrixParam<1, 3>>("target"),
-                            {0, 1, 0});
-                        break;
-                    case 4:
-                        mat = horizontal_fov_projection_matrix(
-                            pm.emplace_param<FloatParam<>>("fov", 60),
-                            pm.emplace_param<FloatParam<>>("aspect_ratio", 1),
-                            pm.emplace_param<FloatParam<>>("close", 0.5),
-                            pm.emplace_param<FloatParam<>>("far", 100));
-                        break;
-                    default:
-                        break;
-                }
-                points[i] = m4_cross_v3(mat, points[i]);
-            }
-            points[i] += Point3f{float(COLS) / 2, float(LINES) / 2, 0};
-        }
+        FrameStats stats;
+        Eigen::Matrix4f stages[4];
+        build_stages(pm, order, stages);
+        render_frame(scene, stages, camera_position(pm), buf, color, ch,
+                     stats);
 
         clear();
         attron(color_to_attr({0, 0, 0, 1, 0, 0}));
@@ -77,27 +385,31 @@ int main() {
         printw(" %.3f", color[1]);
         attron(color_to_attr({0, 0, 0, 0, 0, 1}));
         printw(" %.3f", color[2]);
-        for (int i = 0; i < 4; ++i) {
+        auto& points = scene.points;
+        for (size_t i = 0; i < points.size() && i < 4; ++i) {
             attron(color_to_attr({0, 0, 0, 1, 1, 1}));
             addch(' ');
             printw("(%.3f %.3f %.3f)", points[i][0], points[i][1],
                    points[i][2]);
             attroff(A_UNDERLINE);
         }
-        auto start = chrono::high_resolution_clock::now();
-        buf.clear();
-        buf.set_color({0, 0, 0, color[0], color[1], color[2]});
-        for (auto i : faces) {
-            buf.draw_tri({round(points[i[0]][0]), round(points[i[0]][1])},
-                         {round(points[i[1]][0]), round(points[i[1]][1])},
-                         {round(points[i[2]][0]), round(points[i[2]][1])}, ch);
-        }
         buf.print(0, 1);
         attron(color_to_attr({0, 0, 0, 1, 1, 1}));
         mvprintw(1, 0, "Time spent: %lliu",
-                 chrono::duration_cast<chrono::microseconds>(
-                     chrono::high_resolution_clock::now() - start)
-                     .count());
+                 stats.transformUs + stats.rasterUs + stats.terrainUs +
+                     stats.cloudUs);
+        if (scene.ring.is_open()) {
+            printw(" frame: %llu retries: %d torn: %llu",
+                   (unsigned long long)stats.frame, stats.retries,
+                   (unsigned long long)scene.tornFrames);
+        }
+        if (scene.cloud.size() > 0) {
+            printw(" points: %zu cells: %zu", scene.cloud.size(), stats.cells);
+        }
+        if (scene.terrain.is_open()) {
+            printw(" chunks: %zu triangles: %zu",
+                   scene.terrain.get_chunks().size(), stats.triangles);
+        }
 
         refresh();
         pm.draw();
@@ -106,6 +418,9 @@ int main() {
             pm.process();
         } else {
             auto input = getch();
+            if (input == ERR) {
+                continue;
+            }
             switch (input & 0xFF | (input > 0xFF ? 0x100 : 0)) {
                 case KEY_F(3):
                     pm.active = true;
@@ -0,0 +1,78 @@
+#include "batch_script.h"
+#include "util.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+static bool parse_components(const std::string& token,
+                             std::vector<long double>& out) {
+    out.clear();
+    std::stringstream in(token);
+    std::string part;
+    while (std::getline(in, part, ',')) {
+        char* end;
+        long double value = strtold(part.c_str(), &end);
+        if (part.empty() || *end != '\0') {
+            return false;
+        }
+        out.push_back(value);
+    }
+    return !out.empty();
+}
+
+std::string ParamSweep::value_at(int frame, int frames) const {
+    long double t = frames > 1 ? (long double)frame / (frames - 1) : 0;
+    std::string out;
+    for (size_t i = 0; i < from.size(); ++i) {
+        if (i != 0) {
+            out.push_back(',');
+        }
+        out += ldtos(from[i] + (to[i] - from[i]) * t);
+    }
+    return out;
+}
+
+bool BatchScript::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    frames = 100;
+    sweeps.clear();
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::vector<std::string> tokens;
+        for (std::string token; in >> token;) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        std::string where = path + ":" + std::to_string(number) + ": ";
+        if (tokens[0] == "frames") {
+            if (tokens.size() != 2 || atoi(tokens[1].c_str()) <= 0) {
+                error = where + "expected 'frames <count>'";
+                return false;
+            }
+            frames = atoi(tokens[1].c_str());
+            continue;
+        }
+
+        ParamSweep sweep;
+        sweep.name = tokens[0];
+        if (tokens.size() < 2 || tokens.size() > 3 ||
+            !parse_components(tokens[1], sweep.from) ||
+            !parse_components(tokens.back(), sweep.to) ||
+            sweep.from.size() != sweep.to.size()) {
+            error = where + "expected '<param> <value> [<end value>]'";
+            return false;
+        }
+        sweeps.push_back(sweep);
+    }
+    return true;
+}
@@ -1,4 +1,5 @@
 #include "console_draw.h"
+#include <cstdio>
 #include <pdcurses/curses.h>
 
 void print_matrix(Eigen::Matrix4f mat) {
@@ -67,6 +68,59 @@ void ScreenBuffer::print(int x, int y) {
     }
 }
 
+// Serializes the buffer as a terminal would receive it: one truecolor SGR
+// sequence whenever color or attributes change, rows split by newlines.
+// Returns the number of bytes written to out.
+size_t ScreenBuffer::dump(std::string& out) const {
+    out.clear();
+    chtype last = ~chtype(0);
+    char sgr[64];
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            chtype cell  = buf[y][x];
+            chtype style = cell & A_ATTRIBUTES;
+            if (style != last) {
+                int pair = PAIR_NUMBER(style);
+                int fg   = pair > 0 ? (pair - 1) % USED_COLORS : USED_COLORS - 1;
+                int bg   = pair > 0 ? (pair - 1) / USED_COLORS : 0;
+                int step = 255 / (COLOR_DEPTH - 1);
+                out += "\x1b[0";
+                if (style & A_BOLD) {
+                    out += ";1";
+                }
+                if (style & A_ITALIC) {
+                    out += ";3";
+                }
+                if (style & A_UNDERLINE) {
+                    out += ";4";
+                }
+                snprintf(sgr, sizeof(sgr), ";38;2;%d;%d;%d;48;2;%d;%d;%dm",
+                         fg / (COLOR_DEPTH * COLOR_DEPTH) * step,
+                         fg / COLOR_DEPTH % COLOR_DEPTH * step,
+                         fg % COLOR_DEPTH * step,
+                         bg / (COLOR_DEPTH * COLOR_DEPTH) * step,
+                         bg / COLOR_DEPTH % COLOR_DEPTH * step,
+                         bg % COLOR_DEPTH * step);
+                out += sgr;
+                last = style;
+            }
+            out.push_back(char(cell & A_CHARTEXT));
+        }
+        out.push_back('\n');
+    }
+    return out.size();
+}
+
+size_t ScreenBuffer::filled() const {
+    size_t count = 0;
+    for (auto& row : buf) {
+        for (auto cell : row) {
+            count += (cell & A_CHARTEXT) != ' ';
+        }
+    }
+    return count;
+}
+
 void ScreenBuffer::set_attr(attr_t attr) { this->attr = attr; }
 
 void ScreenBuffer::set_color(CharColor color) {
@@ -0,0 +1,188 @@
+#include "point_cloud.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+// Points transformed per step; small enough to stay in L1.
+#define CLOUD_BLOCK 1024
+
+PointCloud::PointCloud(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    this->threads = threads;
+    histograms.resize(threads);
+}
+
+void PointCloud::clear() {
+    xs.clear();
+    ys.clear();
+    zs.clear();
+}
+
+void PointCloud::reserve(size_t n) {
+    xs.reserve(n);
+    ys.reserve(n);
+    zs.reserve(n);
+}
+
+void PointCloud::add(Point3f point) {
+    xs.push_back(point[0]);
+    ys.push_back(point[1]);
+    zs.push_back(point[2]);
+}
+
+bool PointCloud::load_xyz(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (bytes < 0) {
+        fclose(file);
+        return false;
+    }
+
+    size_t n = bytes / (3 * sizeof(float));
+    clear();
+    xs.resize(n);
+    ys.resize(n);
+    zs.resize(n);
+
+    float chunk[3 * CLOUD_BLOCK];
+    size_t read = 0;
+    while (read < n) {
+        size_t count = std::min<size_t>(CLOUD_BLOCK, n - read);
+        if (fread(chunk, 3 * sizeof(float), count, file) != count) {
+            fclose(file);
+            clear();
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            xs[read + i] = chunk[3 * i];
+            ys[read + i] = chunk[3 * i + 1];
+            zs[read + i] = chunk[3 * i + 2];
+        }
+        read += count;
+    }
+    fclose(file);
+    return true;
+}
+
+void PointCloud::accumulate(Histogram& hist, size_t from, size_t to,
+                            const Eigen::Matrix4f& transform, Point2f offset,
+                            int width, int height) const {
+    typedef Eigen::Array<float, Eigen::Dynamic, 1, 0, CLOUD_BLOCK, 1> Block;
+    typedef Eigen::Array<int, Eigen::Dynamic, 1, 0, CLOUD_BLOCK, 1> CellBlock;
+
+    // One spare cell at the end soaks up every point that misses the
+    // buffer, so the scatter loop below runs without branches.
+    size_t cells = size_t(width) * height;
+    hist.hits.assign(cells + 1, 0);
+    hist.depth.assign(cells + 1, std::numeric_limits<float>::infinity());
+
+    const Eigen::Matrix4f& m = transform;
+    for (size_t i = from; i < to; i += CLOUD_BLOCK) {
+        int n = std::min<size_t>(CLOUD_BLOCK, to - i);
+        Eigen::Map<const Block> x(xs.data() + i, n);
+        Eigen::Map<const Block> y(ys.data() + i, n);
+        Eigen::Map<const Block> z(zs.data() + i, n);
+
+        Block cx    = (m(0, 0) * x + m(0, 1) * y + m(0, 2) * z +
+                    (m(0, 3) + offset[0]))
+                       .round();
+        Block cy    = (m(1, 0) * x + m(1, 1) * y + m(1, 2) * z +
+                    (m(1, 3) + offset[1]))
+                       .round();
+        Block depth = m(2, 0) * x + m(2, 1) * y + m(2, 2) * z + m(2, 3);
+        // Bounds are checked in float: points near or behind the camera
+        // plane come out huge or NaN (which fails every comparison), and
+        // only indices already known to be in range are cast to int.
+        // width * height stays far below 2^24, so the float index is exact.
+        CellBlock cell =
+            (cx >= 0 && cx < float(width) && cy >= 0 && cy < float(height))
+                .select(cy * float(width) + cx, float(cells))
+                .cast<int>();
+
+        for (int j = 0; j < n; ++j) {
+            ++hist.hits[cell[j]];
+            hist.depth[cell[j]] = std::min(hist.depth[cell[j]], depth[j]);
+        }
+    }
+}
+
+size_t PointCloud::draw(ScreenBuffer& buf, const Eigen::Matrix4f& transform,
+                        Point2f offset, Color color) {
+    int width    = buf.get_width();
+    int height   = buf.get_height();
+    size_t n     = size();
+    size_t cells = size_t(width) * height;
+    if (n == 0 || cells == 0) {
+        return 0;
+    }
+
+    // Every thread bins its own slice into a private histogram, so the hot
+    // loop needs no atomics; the histograms are merged into the first one.
+    unsigned used = std::min<size_t>(threads, (n + CLOUD_BLOCK - 1) / CLOUD_BLOCK);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < used; ++t) {
+        workers.emplace_back(&PointCloud::accumulate, this,
+                             std::ref(histograms[t]), n * t / used,
+                             n * (t + 1) / used, std::cref(transform), offset,
+                             width, height);
+    }
+    accumulate(histograms[0], 0, n / used, transform, offset, width, height);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Histogram& total = histograms[0];
+    for (unsigned t = 1; t < used; ++t) {
+        for (size_t c = 0; c < cells; ++c) {
+            total.hits[c] += histograms[t].hits[c];
+            total.depth[c] = std::min(total.depth[c], histograms[t].depth[c]);
+        }
+    }
+
+    uint32_t maxHits = 0;
+    float near       = std::numeric_limits<float>::infinity();
+    float far        = -std::numeric_limits<float>::infinity();
+    size_t lit       = 0;
+    for (size_t c = 0; c < cells; ++c) {
+        if (total.hits[c] == 0) {
+            continue;
+        }
+        ++lit;
+        maxHits = std::max(maxHits, total.hits[c]);
+        near    = std::min(near, total.depth[c]);
+        far     = std::max(far, total.depth[c]);
+    }
+    if (lit == 0) {
+        return 0;
+    }
+
+    // Density is log scaled so sparse edges stay visible next to dense
+    // cores, depth dims cells that are further away.
+    const char* ramp = DENSITY_RAMP;
+    int levels       = strlen(ramp) - 1;
+    float logMax     = logf(1.0f + maxHits);
+    float range      = far > near ? far - near : 1;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            size_t c = size_t(y) * width + x;
+            if (total.hits[c] == 0) {
+                continue;
+            }
+            int level = 1 + int(logf(1.0f + total.hits[c]) / logMax * (levels - 1) + 0.5f);
+            float shade = 1 - 0.75f * (total.depth[c] - near) / range;
+            Color fg    = color * shade;
+            buf.put(x, y, ramp[level], {0, 0, 0, fg[0], fg[1], fg[2]}, 0);
+        }
+    }
+    return lit;
+}
@@ -0,0 +1,198 @@
+#include "shm_ring.h"
+#include <algorithm>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static size_t align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static size_t header_size() { return align_up(sizeof(ShmRingHeader), 64); }
+
+static size_t slot_size(uint32_t maxPoints, uint32_t maxFaces) {
+    return align_up(sizeof(ShmRingSlot) + maxPoints * sizeof(Point3f) +
+                        maxFaces * sizeof(ShmFace),
+                    64);
+}
+
+static std::string shm_object_name(std::string name) {
+    if (name.empty() || name[0] != '/') {
+        name.insert(name.begin(), '/');
+    }
+    return name;
+}
+
+ShmRing::~ShmRing() { close(); }
+
+ShmRingSlot* ShmRing::slot_at(uint64_t frame) const {
+    auto offset = header_size() + (frame - 1) % header->slots * header->slotSize;
+    return reinterpret_cast<ShmRingSlot*>(static_cast<char*>(base) + offset);
+}
+
+Point3f* ShmRing::slot_points(ShmRingSlot* slot) const {
+    return reinterpret_cast<Point3f*>(reinterpret_cast<char*>(slot) +
+                                      sizeof(ShmRingSlot));
+}
+
+ShmFace* ShmRing::slot_faces(ShmRingSlot* slot) const {
+    return reinterpret_cast<ShmFace*>(slot_points(slot) + header->maxPoints);
+}
+
+#ifdef _WIN32
+
+bool ShmRing::create(std::string, uint32_t, uint32_t, uint32_t) {
+    return false;
+}
+
+bool ShmRing::open(std::string) { return false; }
+
+void ShmRing::close() {}
+
+#else
+
+bool ShmRing::create(std::string name, uint32_t slots, uint32_t maxPoints,
+                     uint32_t maxFaces) {
+    close();
+    if (slots == 0) {
+        return false;
+    }
+    this->name = shm_object_name(name);
+
+    // Start from a fresh object: readers still mapping a stale one keep it
+    // alive on their own instead of seeing it truncated under them.
+    shm_unlink(this->name.c_str());
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t slotSize = slot_size(maxPoints, maxFaces);
+    size_t total    = header_size() + slots * slotSize;
+    if (ftruncate(fd, total) != 0) {
+        ::close(fd);
+        shm_unlink(this->name.c_str());
+        return false;
+    }
+    void* mem = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(this->name.c_str());
+        return false;
+    }
+
+    base              = mem;
+    size              = total;
+    owner             = true;
+    written           = 0;
+    header            = new (base) ShmRingHeader();
+    header->version   = SHM_RING_VERSION;
+    header->slots     = slots;
+    header->maxPoints = maxPoints;
+    header->maxFaces  = maxFaces;
+    header->slotSize  = slotSize;
+    for (uint32_t i = 1; i <= slots; ++i) {
+        new (slot_at(i)) ShmRingSlot();
+    }
+    header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool ShmRing::open(std::string name) {
+    close();
+    this->name = shm_object_name(name);
+
+    int fd = shm_open(this->name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < header_size()) {
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+
+    base   = mem;
+    size   = st.st_size;
+    owner  = false;
+    header = static_cast<ShmRingHeader*>(base);
+    if (header->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC) {
+        close();
+        return false;
+    }
+    if (header->version != SHM_RING_VERSION || header->slots == 0 ||
+        header->slotSize != slot_size(header->maxPoints, header->maxFaces) ||
+        header_size() + size_t(header->slots) * header->slotSize > size) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ShmRing::close() {
+    if (base != nullptr) {
+        munmap(base, size);
+        if (owner) {
+            shm_unlink(name.c_str());
+        }
+    }
+    base   = nullptr;
+    size   = 0;
+    owner  = false;
+    header = nullptr;
+}
+
+#endif
+
+void ShmRing::begin_write(Point3f*& points, ShmFace*& faces) {
+    ShmRingSlot* slot = slot_at(written + 1);
+    slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    points = slot_points(slot);
+    faces  = slot_faces(slot);
+}
+
+void ShmRing::end_write(uint32_t pointCount, uint32_t faceCount) {
+    ShmRingSlot* slot = slot_at(++written);
+    slot->pointCount  = std::min(pointCount, header->maxPoints);
+    slot->faceCount   = std::min(faceCount, header->maxFaces);
+    slot->seq.store(slot->seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    header->latest.store(written, std::memory_order_release);
+}
+
+bool ShmRing::acquire(ShmFrameView& view) const {
+    uint64_t frame = header->latest.load(std::memory_order_acquire);
+    if (frame == 0) {
+        return false;
+    }
+    ShmRingSlot* slot = slot_at(frame);
+    uint64_t seq      = slot->seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+        return false;
+    }
+    // Counts are clamped so a torn read can never index past the slot.
+    view.points     = slot_points(slot);
+    view.faces      = slot_faces(slot);
+    view.pointCount = std::min(slot->pointCount, header->maxPoints);
+    view.faceCount  = std::min(slot->faceCount, header->maxFaces);
+    view.frame      = frame;
+    view.seq        = seq;
+    view.slot       = slot;
+    return true;
+}
+
+bool ShmRing::validate(const ShmFrameView& view) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->seq.load(std::memory_order_relaxed) == view.seq;
+}
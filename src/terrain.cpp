@@ -0,0 +1,276 @@
+#include "terrain.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Maps the whole file read only; returns nullptr on failure.
+static void* map_file(const std::string& path, size_t& bytes) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    // The view keeps the mapping and the file alive, so both handles can
+    // go right away
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+    void* mem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    bytes = size_t(size.QuadPart);
+    return mem;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    bytes = st.st_size;
+    return mem == MAP_FAILED ? nullptr : mem;
+#endif
+}
+
+static void unmap_file(void* mem, size_t bytes) {
+#ifdef _WIN32
+    UnmapViewOfFile(mem);
+#else
+    munmap(mem, bytes);
+#endif
+}
+
+Terrain::~Terrain() { close(); }
+
+bool Terrain::open(const std::string& path) {
+    close();
+    if (chunkSamples < 1 || maxLod < 0) {
+        return false;
+    }
+
+    size_t bytes = 0;
+    void* mem    = map_file(path, bytes);
+    if (mem == nullptr) {
+        return false;
+    }
+    int n = int(sqrt(double(bytes / 2)) + 0.5);
+    if (n < 2 || size_t(n) * n * 2 != bytes) {
+        unmap_file(mem, bytes);
+        return false;
+    }
+
+    map           = mem;
+    mapSize       = bytes;
+    samples       = static_cast<const uint8_t*>(mem);
+    side          = n;
+    chunksPerSide = (side - 1 + chunkSamples - 1) / chunkSamples;
+    stopping      = false;
+    worker        = std::thread(&Terrain::work, this);
+    return true;
+}
+
+void Terrain::close() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+    chunks.clear();
+    pending.clear();
+    ready.clear();
+    inFlight.clear();
+    if (map != nullptr) {
+        unmap_file(map, mapSize);
+    }
+    map           = nullptr;
+    mapSize       = 0;
+    samples       = nullptr;
+    side          = 0;
+    chunksPerSide = 0;
+}
+
+float Terrain::sample(int x, int z) const {
+    const uint8_t* at = samples + (size_t(z) * side + x) * 2;
+    return float(at[0] | at[1] << 8) / 65535 * heightScale;
+}
+
+float Terrain::chunk_distance(ChunkKey key, Point3f camera) const {
+    float chunkWorld = chunkSamples * spacing;
+    float edge       = (side - 1) * spacing;
+    float x0         = key.first * chunkWorld;
+    float z0         = key.second * chunkWorld;
+    float x1         = std::min(x0 + chunkWorld, edge);
+    float z1         = std::min(z0 + chunkWorld, edge);
+    float dx         = std::max({0.0f, x0 - camera[0], camera[0] - x1});
+    float dz         = std::max({0.0f, z0 - camera[2], camera[2] - z1});
+    return sqrtf(dx * dx + dz * dz);
+}
+
+std::unique_ptr<Terrain::Chunk> Terrain::build(const Request& request) const {
+    int step = 1 << request.lod;
+    int x0   = request.key.first * chunkSamples;
+    int z0   = request.key.second * chunkSamples;
+    int x1   = std::min(x0 + chunkSamples, side - 1);
+    int z1   = std::min(z0 + chunkSamples, side - 1);
+
+    // Edges are always kept so neighbouring chunks share their border
+    std::vector<int> xs;
+    std::vector<int> zs;
+    for (int x = x0; x < x1; x += step) {
+        xs.push_back(x);
+    }
+    xs.push_back(x1);
+    for (int z = z0; z < z1; z += step) {
+        zs.push_back(z);
+    }
+    zs.push_back(z1);
+
+    auto chunk = std::make_unique<Chunk>();
+    chunk->x   = request.key.first;
+    chunk->z   = request.key.second;
+    chunk->lod = request.lod;
+    chunk->points.reserve(xs.size() * zs.size());
+    for (int z : zs) {
+        for (int x : xs) {
+            chunk->points.push_back({x * spacing, sample(x, z), z * spacing});
+        }
+    }
+
+    uint32_t row = xs.size();
+    chunk->faces.reserve(2 * (xs.size() - 1) * (zs.size() - 1));
+    for (uint32_t i = 0; i + 1 < zs.size(); ++i) {
+        for (uint32_t j = 0; j + 1 < row; ++j) {
+            uint32_t a = i * row + j;
+            uint32_t b = a + 1;
+            uint32_t c = a + row;
+            uint32_t d = c + 1;
+            chunk->faces.push_back({a, b, c});
+            chunk->faces.push_back({b, d, c});
+        }
+    }
+    return chunk;
+}
+
+void Terrain::work() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !pending.empty(); });
+        if (stopping) {
+            return;
+        }
+        Request request = pending.back();
+        pending.pop_back();
+        inFlight[request.key] = request.lod;
+
+        // Page faults on the mapped file happen here, off the render thread
+        guard.unlock();
+        auto chunk = build(request);
+        guard.lock();
+
+        inFlight.erase(request.key);
+        ready.push_back(std::move(chunk));
+        built.notify_all();
+    }
+}
+
+void Terrain::wait_idle() {
+    std::unique_lock<std::mutex> guard(lock);
+    built.wait(guard, [this] { return pending.empty() && inFlight.empty(); });
+}
+
+bool Terrain::update(Point3f camera) {
+    if (!is_open()) {
+        return true;
+    }
+
+    float chunkWorld = chunkSamples * spacing;
+    int xMin = std::max(0, int(floorf((camera[0] - viewDistance) / chunkWorld)));
+    int xMax = std::min(chunksPerSide - 1,
+                        int(floorf((camera[0] + viewDistance) / chunkWorld)));
+    int zMin = std::max(0, int(floorf((camera[2] - viewDistance) / chunkWorld)));
+    int zMax = std::min(chunksPerSide - 1,
+                        int(floorf((camera[2] + viewDistance) / chunkWorld)));
+
+    std::map<ChunkKey, Request> wanted;
+    for (int x = xMin; x <= xMax; ++x) {
+        for (int z = zMin; z <= zMax; ++z) {
+            ChunkKey key{x, z};
+            float distance = chunk_distance(key, camera);
+            if (distance > viewDistance) {
+                continue;
+            }
+            int lod     = std::min(maxLod, int(distance / lodDistance));
+            wanted[key] = {key, lod, distance};
+        }
+    }
+
+    std::vector<std::unique_ptr<Chunk>> finished;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished.swap(ready);
+    }
+    // A chunk at a stale LOD still beats a hole until its rebuild arrives
+    for (auto& chunk : finished) {
+        ChunkKey key{chunk->x, chunk->z};
+        if (wanted.count(key) != 0) {
+            chunks[key] = std::move(chunk);
+        }
+    }
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        if (wanted.count(it->first) == 0) {
+            it = chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    pending.clear();
+    for (auto& entry : wanted) {
+        auto active = chunks.find(entry.first);
+        if (active != chunks.end() && active->second->lod == entry.second.lod) {
+            continue;
+        }
+        auto building = inFlight.find(entry.first);
+        if (building != inFlight.end() && building->second == entry.second.lod) {
+            continue;
+        }
+        pending.push_back(entry.second);
+    }
+    // The worker takes from the back, so the nearest chunk goes last
+    std::sort(pending.begin(), pending.end(),
+              [](const Request& a, const Request& b) {
+                  return a.distance > b.distance;
+              });
+    if (!pending.empty()) {
+        wake.notify_one();
+    }
+    return pending.empty() && inFlight.empty();
+}
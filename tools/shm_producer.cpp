@@ -0,0 +1,103 @@
+#include "shm_ring.h"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Local test producer for the viewer's --shm ingest mode: pushes an animated
+// wave grid into the ring buffer as fast as requested.
+//   usage: shm_producer [name] [frames per second, 0 = unthrottled] [grid]
+//                       [slots]
+// More slots give the viewer longer before a frame it is drawing gets
+// overwritten, at the cost of memory.
+
+using namespace std;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int) { running = 0; }
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "/3dc_ring";
+    int rate         = argc > 2 ? atoi(argv[2]) : 1000;
+    int grid         = argc > 3 ? atoi(argv[3]) : 16;
+    int slots        = argc > 4 ? atoi(argv[4]) : 4;
+    if (grid < 1) {
+        grid = 1;
+    }
+    if (slots < 1) {
+        slots = 1;
+    }
+
+    uint32_t maxPoints = (grid + 1) * (grid + 1);
+    uint32_t maxFaces  = 2 * grid * grid;
+
+    ShmRing ring;
+    if (!ring.create(name, slots, maxPoints, maxFaces)) {
+        fprintf(stderr, "Failed to create shared memory ring %s\n", name);
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("Producing %dx%d grid into %s, Ctrl+C to stop\n", grid, grid, name);
+
+    auto period = rate > 0 ? chrono::nanoseconds(1000000000 / rate)
+                           : chrono::nanoseconds(0);
+    auto start  = chrono::steady_clock::now();
+    auto next   = start;
+    auto report = start + chrono::seconds(1);
+    uint64_t frames     = 0;
+    uint64_t lastFrames = 0;
+
+    while (running) {
+        float t = chrono::duration<float>(chrono::steady_clock::now() - start)
+                      .count();
+
+        Point3f* points;
+        ShmFace* faces;
+        ring.begin_write(points, faces);
+        for (int i = 0; i <= grid; ++i) {
+            for (int j = 0; j <= grid; ++j) {
+                float x = 4.0f * j / grid - 2;
+                float z = 4.0f * i / grid - 2;
+                float y = 0.5f * sinf(x * 2 + t * 3) * cosf(z * 2 + t * 2);
+                points[i * (grid + 1) + j] = {x, y, z};
+            }
+        }
+        uint32_t face = 0;
+        for (uint32_t i = 0; i < uint32_t(grid); ++i) {
+            for (uint32_t j = 0; j < uint32_t(grid); ++j) {
+                uint32_t a = i * (grid + 1) + j;
+                uint32_t b = a + 1;
+                uint32_t c = a + grid + 1;
+                uint32_t d = c + 1;
+                faces[face][0] = a, faces[face][1] = b, faces[face][2] = c;
+                ++face;
+                faces[face][0] = b, faces[face][1] = d, faces[face][2] = c;
+                ++face;
+            }
+        }
+        ring.end_write(maxPoints, face);
+        ++frames;
+
+        auto now = chrono::steady_clock::now();
+        if (now >= report) {
+            printf("%llu frames/s\n", (unsigned long long)(frames - lastFrames));
+            fflush(stdout);
+            lastFrames = frames;
+            report += chrono::seconds(1);
+        }
+        if (period.count() > 0) {
+            next += period;
+            if (next > now) {
+                this_thread::sleep_until(next);
+            } else {
+                next = now;
+            }
+        }
+    }
+
+    return 0;
+}